@@ -0,0 +1,46 @@
+#!/bin/sh
+# Generates bench_calls.grbc, a call heavy benchmark for write ahead buffers
+#
+# Sector 0 calls sector 1 100 times, every call to sector 1 calls sector 2 100
+# times, and every call to sector 2 calls sector 3 50 times, about 510k sector
+# calls in total. Each call passes two write ahead buffers, long enough that
+# they don't fit in the small string buffer
+#
+# Usage: ./bench_calls.sh [CALLS1] [CALLS2] [CALLS3] > bench_calls.grbc
+
+calls1=${1:-100}
+calls2=${2:-100}
+calls3=${3:-50}
+
+arg0=graphite_benchmark_argument_zero_long_enough_to_allocate
+arg1=graphite_benchmark_argument_one_long_enough_to_allocate
+
+# calls TARGET COUNT
+calls() {
+  i=0
+  while [ "$i" -lt "$2" ]; do
+    echo "WABWRITE-$1,0,$arg0"
+    echo "WABWRITE-$1,1,$arg1"
+    echo "GOTOSECTOR-$1"
+    i=$((i + 1))
+  done
+}
+
+echo "#-#"
+calls 1 "$calls1"
+echo "REGWRITE-0,\$#0\$"
+echo "#-#"
+echo "#-#"
+echo "WABCPYTOBUF-0,0"
+echo "WABCPYTOBUF-1,1"
+calls 2 "$calls2"
+echo "#-#"
+echo "#-#"
+echo "WABCPYTOBUF-0,0"
+echo "WABCPYTOBUF-1,1"
+calls 3 "$calls3"
+echo "#-#"
+echo "#-#"
+echo "WABCPYTOBUF-0,2"
+echo "WABCPYTOBUF-1,3"
+printf "#-#"
@@ -0,0 +1,144 @@
+#pragma once
+#include "vm.hh"
+#include <cctype>
+#include <deque>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// Cooperative round robin scheduler, interleaves many programs on a single
+// thread. Each program runs for at most instructionBudget instructions before
+// the next one gets a turn, programs waiting on the STDIN register are parked
+// until input is fed to them
+struct VirtualMachineScheduler {
+  // A budget of zero or less runs each program until it halts or blocks
+  int instructionBudget;
+
+  // std::deque keeps references to existing instances valid on push_back
+  std::deque<VirtualMachine> instances;
+  std::deque<size_t> runQueue;
+  std::deque<size_t> parked; // Blocked programs, in the order they blocked
+
+  // Bytes read from stdin which haven't been handed to a program yet
+  std::string stdinBuffer;
+  bool stdinClosed = false;
+
+  VirtualMachineScheduler(int budget = 1000) : instructionBudget(budget) {}
+
+  // Add a program to the scheduler, returns the id of the new instance
+  size_t spawn(std::vector<VirtualMachineSector> sectors) {
+    instances.emplace_back(std::move(sectors), false);
+    instances.back().instanceId = instances.size() - 1;
+    runQueue.push_back(instances.size() - 1);
+
+    return instances.size() - 1;
+  }
+
+  // Queue input for an instance, and unpark it if it was waiting on input
+  void feedInput(size_t instanceId, std::string input) {
+    instances.at(instanceId).feedInput(input);
+
+    for (auto it = parked.begin(); it != parked.end(); it++) {
+      if (*it == instanceId) {
+        parked.erase(it);
+        runQueue.push_back(instanceId);
+        break;
+      }
+    }
+  }
+
+  // Append whatever stdin has available to stdinBuffer. Only waits for
+  // input when block is set, otherwise returns straight away
+  void readInput(bool block) {
+    if (stdinClosed) {
+      return;
+    }
+
+    pollfd stdinPoll{0, POLLIN, 0};
+
+    if (poll(&stdinPoll, 1, block ? -1 : 0) <= 0) {
+      return;
+    }
+
+    char chunk[4096];
+    ssize_t count = read(0, chunk, sizeof(chunk));
+
+    if (count <= 0) {
+      stdinClosed = true;
+      return;
+    }
+
+    stdinBuffer.append(chunk, count);
+  }
+
+  // Take the next whitespace separated word out of stdinBuffer. A word is only
+  // complete once whitespace follows it, or stdin has been closed
+  bool nextWord(std::string *word) {
+    size_t start = 0;
+
+    while (start < stdinBuffer.size() &&
+           std::isspace((unsigned char)stdinBuffer[start])) {
+      start++;
+    }
+
+    size_t end = start;
+
+    while (end < stdinBuffer.size() &&
+           !std::isspace((unsigned char)stdinBuffer[end])) {
+      end++;
+    }
+
+    if (start == end || (end == stdinBuffer.size() && !stdinClosed)) {
+      stdinBuffer.erase(0, start);
+      return false;
+    }
+
+    *word = stdinBuffer.substr(start, end - start);
+    stdinBuffer.erase(0, end);
+
+    return true;
+  }
+
+  // Give every runnable program a time slice until all of them have halted.
+  // Between time slices, complete words already available on stdin are
+  // handed to the programs which have been waiting the longest. The scheduler
+  // only blocks on stdin when every remaining program is parked
+  template <typename Policy = VirtualMachineDefaultPolicy> void run() {
+    while (!runQueue.empty() || !parked.empty()) {
+      if (!parked.empty()) {
+        readInput(runQueue.empty());
+
+        std::string input;
+
+        while (!parked.empty() && nextWord(&input)) {
+          feedInput(parked.front(), input);
+        }
+
+        if (runQueue.empty()) {
+          if (stdinClosed) {
+            throw std::runtime_error(
+                "Reached end of input while programs are waiting on STDIN");
+          }
+
+          continue;
+        }
+      }
+
+      size_t instanceId = runQueue.front();
+      runQueue.pop_front();
+
+      switch (instances.at(instanceId).execute<Policy>(instructionBudget)) {
+      case RUNNING:
+        runQueue.push_back(instanceId);
+        break;
+      case BLOCKED:
+        parked.push_back(instanceId);
+        break;
+      case HALTED:
+        break;
+      }
+    }
+  }
+};
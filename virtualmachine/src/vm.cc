@@ -1,4 +1,5 @@
 #include "vm.hh"
+#include "scheduler.hh"
 #include "txttable.h"
 #include <algorithm>
 #include <fstream>
@@ -7,29 +8,38 @@
 #include <vector>
 
 // Represents a single instruction given to the VM
-VirtualMachineInstructionResult VirtualMachineInstruction::execute(
+template <typename Policy>
+VIRTUAL_MACHINE_ALWAYS_INLINE VirtualMachineInstructionResult
+VirtualMachineInstruction::execute(
     std::vector<VirtualMachineRegister> *registers,
     std::vector<VirtualMachineBuffer> *buffers,
     std::vector<VirtualMachineBuffer> *tmpBuffers) {
   if (op == VirtualMachineInstructionType::BUFWRITE) {
 
-    int slot = std::stoi(evalSpecialStatement(params[0], buffers, registers));
+    int slot =
+        std::stoi(evalSpecialStatement<Policy>(params[0], buffers, registers));
 
     VirtualMachineBuffer buffer{};
     buffer.slot = slot;
-    buffer.value = evalSpecialStatement(params[1], buffers, registers);
+    buffer.value = evalSpecialStatement<Policy>(params[1], buffers, registers);
 
     buffers->push_back(buffer);
   } else if (op == VirtualMachineInstructionType::REGWRITE) {
-    int slot = std::stoi(evalSpecialStatement(params[0], buffers, registers));
+    int slot =
+        std::stoi(evalSpecialStatement<Policy>(params[0], buffers, registers));
 
-    registers->at(slot).writeRegisterValue(
-        evalSpecialStatement(params[1], buffers, registers));
+    if (!slotAt<Policy>(registers, slot).writeRegisterValue(
+            evalSpecialStatement<Policy>(params[1], buffers, registers))) {
+      VirtualMachineInstructionResult result{};
+      result.blockedOnInput = true;
+
+      return result;
+    }
   } else if (op == VirtualMachineInstructionType::REGCPYTOBUF) {
     int registerSlot =
-        std::stoi(evalSpecialStatement(params[0], buffers, registers));
+        std::stoi(evalSpecialStatement<Policy>(params[0], buffers, registers));
     int bufferSlot =
-        std::stoi(evalSpecialStatement(params[1], buffers, registers));
+        std::stoi(evalSpecialStatement<Policy>(params[1], buffers, registers));
 
     // Copy the contents of the register into the buffer
     // Overwrites the contents of the buffer, with the value of the register
@@ -38,34 +48,45 @@ VirtualMachineInstructionResult VirtualMachineInstruction::execute(
     if (bufferSlot >= buffers->size()) {
       VirtualMachineBuffer buffer{};
       buffer.slot = bufferSlot;
-      buffer.value = registers->at(registerSlot).readRegisterValue();
+      buffer.value =
+          slotAt<Policy>(registers, registerSlot).readRegisterValue();
 
       buffers->push_back(buffer);
     } else {
-      buffers->at(bufferSlot).value = registers->at(registerSlot).value;
+      slotAt<Policy>(buffers, bufferSlot).value =
+          slotAt<Policy>(registers, registerSlot).value;
     }
   } else if (op == VirtualMachineInstructionType::BUFCPYTOREG) {
     int bufferSlot =
-        std::stoi(evalSpecialStatement(params[0], buffers, registers));
+        std::stoi(evalSpecialStatement<Policy>(params[0], buffers, registers));
     int registerSlot =
-        std::stoi(evalSpecialStatement(params[1], buffers, registers));
+        std::stoi(evalSpecialStatement<Policy>(params[1], buffers, registers));
 
-    if (bufferSlot >= buffers->size()) {
-      throw std::runtime_error("Invalid buffer slot for copy");
+    if constexpr (Policy::checked) {
+      if (bufferSlot >= buffers->size()) {
+        throw std::runtime_error("Invalid buffer slot for copy");
+      }
     }
 
-    registers->at(registerSlot)
-        .writeRegisterValue(buffers->at(bufferSlot).value);
+    if (!slotAt<Policy>(registers, registerSlot)
+             .writeRegisterValue(slotAt<Policy>(buffers, bufferSlot).value)) {
+      VirtualMachineInstructionResult result{};
+      result.blockedOnInput = true;
+
+      return result;
+    }
   } else if (op == VirtualMachineInstructionType::GOTOSECTOR) {
     VirtualMachineInstructionResult result{};
     result.gotoSector = true;
     result.sectorId =
-        std::stoi(evalSpecialStatement(params[0], buffers, registers));
+        std::stoi(evalSpecialStatement<Policy>(params[0], buffers, registers));
 
     return result;
   } else if (op == VirtualMachineInstructionType::ADD) {
-    int num1 = std::stoi(evalSpecialStatement(params[0], buffers, registers));
-    int num2 = std::stoi(evalSpecialStatement(params[1], buffers, registers));
+    int num1 =
+        std::stoi(evalSpecialStatement<Policy>(params[0], buffers, registers));
+    int num2 =
+        std::stoi(evalSpecialStatement<Policy>(params[1], buffers, registers));
 
     VirtualMachineBuffer buffer{};
     buffer.slot = tmpBuffers->capacity();
@@ -74,8 +95,10 @@ VirtualMachineInstructionResult VirtualMachineInstruction::execute(
     tmpBuffers->push_back(
         buffer); // Write the new temporary buffer into garbage collected memory
   } else if (op == VirtualMachineInstructionType::SUB) {
-    int num1 = std::stoi(evalSpecialStatement(params[0], buffers, registers));
-    int num2 = std::stoi(evalSpecialStatement(params[1], buffers, registers));
+    int num1 =
+        std::stoi(evalSpecialStatement<Policy>(params[0], buffers, registers));
+    int num2 =
+        std::stoi(evalSpecialStatement<Policy>(params[1], buffers, registers));
 
     VirtualMachineBuffer buffer{};
     buffer.slot = tmpBuffers->capacity();
@@ -84,8 +107,10 @@ VirtualMachineInstructionResult VirtualMachineInstruction::execute(
     tmpBuffers->push_back(
         buffer); // Write the new temporary buffer into garbage collected memory
   } else if (op == VirtualMachineInstructionType::MUL) {
-    int num1 = std::stoi(evalSpecialStatement(params[0], buffers, registers));
-    int num2 = std::stoi(evalSpecialStatement(params[1], buffers, registers));
+    int num1 =
+        std::stoi(evalSpecialStatement<Policy>(params[0], buffers, registers));
+    int num2 =
+        std::stoi(evalSpecialStatement<Policy>(params[1], buffers, registers));
 
     VirtualMachineBuffer buffer{};
     buffer.slot = tmpBuffers->capacity();
@@ -94,8 +119,10 @@ VirtualMachineInstructionResult VirtualMachineInstruction::execute(
     tmpBuffers->push_back(
         buffer); // Write the new temporary buffer into garbage collected memory
   } else if (op == VirtualMachineInstructionType::DIV) {
-    int num1 = std::stoi(evalSpecialStatement(params[0], buffers, registers));
-    int num2 = std::stoi(evalSpecialStatement(params[1], buffers, registers));
+    int num1 =
+        std::stoi(evalSpecialStatement<Policy>(params[0], buffers, registers));
+    int num2 =
+        std::stoi(evalSpecialStatement<Policy>(params[1], buffers, registers));
 
     VirtualMachineBuffer buffer{};
     buffer.slot = tmpBuffers->capacity();
@@ -107,31 +134,35 @@ VirtualMachineInstructionResult VirtualMachineInstruction::execute(
 
     // _last_ transforms into the slot of the last buffer inserted into
     // temporary memory
-    if (params[0] == "_last_") {
-      params[0] = std::to_string(tmpBuffers->size() - 1);
-    }
-
-    int tmpBufSlot = std::stoi(params[0]);
+    int tmpBufSlot = params[0] == "_last_" ? tmpBuffers->size() - 1
+                                           : std::stoi(params[0]);
     int bufferSlot = std::stoi(params[1]);
 
     if (bufferSlot >= buffers->size()) {
       // The buffer does not exist, create it
       VirtualMachineBuffer targetBuffer{};
       targetBuffer.slot = bufferSlot;
-      targetBuffer.value = tmpBuffers->at(tmpBufSlot).value;
+      targetBuffer.value = slotAt<Policy>(tmpBuffers, tmpBufSlot).value;
 
       buffers->push_back(targetBuffer);
     } else {
       // Buffer exists, overwrite the value
-      buffers->at(bufferSlot).value = tmpBuffers->at(tmpBufSlot).value;
+      slotAt<Policy>(buffers, bufferSlot).value =
+          slotAt<Policy>(tmpBuffers, tmpBufSlot).value;
     }
   } else if (op == VirtualMachineInstructionType::TMPBUFRM) {
-    if (params[0] == "_last_") {
-      params[0] = std::to_string(tmpBuffers->size() - 1);
-    }
-
     int tmpBufferSlot =
-        std::stoi(evalSpecialStatement(params[0], buffers, registers));
+        params[0] == "_last_"
+            ? tmpBuffers->size() - 1
+            : std::stoi(
+                  evalSpecialStatement<Policy>(params[0], buffers, registers));
+
+    if constexpr (Policy::checked) {
+      if (tmpBufferSlot < 0 ||
+          static_cast<size_t>(tmpBufferSlot) >= tmpBuffers->size()) {
+        throw std::runtime_error("Invalid temporary buffer slot for remove");
+      }
+    }
 
     tmpBuffers->erase(tmpBuffers->begin() + tmpBufferSlot);
   } else if (op == VirtualMachineInstructionType::WABWRITE) {
@@ -151,6 +182,12 @@ VirtualMachineInstructionResult VirtualMachineInstruction::execute(
       bufferCopyId = -1;
     } else {
       bufferCopyId = std::stoi(params[1]);
+
+      // -1 is reserved for _new_
+      if (bufferCopyId < 0) {
+        throw std::runtime_error("Invalid write ahead buffer copy slot: " +
+                                 params[1]);
+      }
     }
 
     VirtualMachineInstructionResult result{};
@@ -159,6 +196,12 @@ VirtualMachineInstructionResult VirtualMachineInstruction::execute(
     result.writeAheadBufferCopyId = bufferCopyId;
 
     return result; 
+  } else if (op == WABRM) {
+    VirtualMachineInstructionResult result{};
+    result.writeAheadBufferRemove = true;
+    result.writeAheadBufferId = std::stoi(params[0]);
+
+    return result;
   } else if (op == BUFRM){
     int slot = std::stoi(params[0]);
 
@@ -166,6 +209,13 @@ VirtualMachineInstructionResult VirtualMachineInstruction::execute(
       VirtualMachineBuffer buffer = buffers->at(i);
 
       if (buffer.slot == slot){
+        if constexpr (Policy::checked) {
+          if (buffer.slot < 0 ||
+              static_cast<size_t>(buffer.slot) >= buffers->size()) {
+            throw std::runtime_error("Invalid buffer slot for remove");
+          }
+        }
+
         buffers->erase(buffers->begin()+buffer.slot);
         break;
       }
@@ -178,6 +228,155 @@ VirtualMachineInstructionResult VirtualMachineInstruction::execute(
   return result;
 }
 
+template <typename Policy>
+VIRTUAL_MACHINE_ALWAYS_INLINE bool
+VirtualMachine::step(VirtualMachineFrame &frame,
+                     VirtualMachineInstruction &instruction) {
+  VirtualMachineInstructionResult result =
+      instruction.execute<Policy>(&registers, &buffers, &tmpBuffers);
+
+  if (result.blockedOnInput) {
+    // Leave the instruction pointer in place, the instruction is retried
+    // once input has been fed to the program
+    return false;
+  }
+
+  frame.instructionPointer++;
+
+  if (result.gotoSector) {
+    VirtualMachineMailbox &pending =
+        slotAt<Policy>(&pendingWriteAheadBuffers, result.sectorId);
+
+    frames.push_back(
+        VirtualMachineFrame{result.sectorId, 0, std::move(pending)});
+  } else if (result.writeAheadToBuffer) {
+    VirtualMachineMailbox &pending =
+        slotAt<Policy>(&pendingWriteAheadBuffers, result.sectorId);
+
+    pending.write<Policy>(result.writeAheadBufferId,
+                          std::move(result.writeAheadBufferContent));
+  } else if (result.writeAheadBufferCopy) {
+    std::string value =
+        frame.writeAheadBuffers.take<Policy>(result.writeAheadBufferId);
+
+    // _new_ copies into a new buffer at the end of program memory
+    if (result.writeAheadBufferCopyId == -1) {
+      result.writeAheadBufferCopyId = buffers.size();
+    }
+
+    if (static_cast<size_t>(result.writeAheadBufferCopyId) >= buffers.size()) {
+      VirtualMachineBuffer copyBuffer{};
+      copyBuffer.slot = result.writeAheadBufferCopyId;
+      copyBuffer.value = std::move(value);
+
+      buffers.push_back(std::move(copyBuffer));
+    } else {
+      buffers[result.writeAheadBufferCopyId].value = std::move(value);
+    }
+  } else if (result.writeAheadBufferRemove) {
+    frame.writeAheadBuffers.remove<Policy>(result.writeAheadBufferId);
+  }
+
+  return true;
+}
+
+// Prints an instruction before it is executed, for --virtual-machine-trace
+VIRTUAL_MACHINE_COLD static void
+traceInstruction(size_t instanceId, int sectorId, size_t instructionPointer,
+                 VirtualMachineInstruction &instruction) {
+  std::cerr << "[#" << instanceId << " " << sectorId << ":"
+            << instructionPointer << "] "
+            << instructionTypeNames[instruction.op];
+
+  for (size_t i = 0; i < instruction.params.size(); i++) {
+    std::cerr << (i == 0 ? "-" : ",") << instruction.params[i];
+  }
+
+  std::cerr << std::endl;
+}
+
+// Rethrows an error raised by an instruction with where the program failed
+[[noreturn]] VIRTUAL_MACHINE_COLD static void
+throwInstructionError(int sectorId, size_t instructionPointer,
+                      VirtualMachineInstruction &instruction,
+                      const std::exception &e) {
+  throw std::runtime_error("Sector " + std::to_string(sectorId) +
+                           ", instruction " +
+                           std::to_string(instructionPointer) + " (" +
+                           instructionTypeNames[instruction.op] +
+                           "): " + e.what());
+}
+
+template <typename Policy>
+VirtualMachineState VirtualMachine::execute(int instructionBudget) {
+  // A budget of zero would never make progress, treat it as no preemption
+  bool budgetLimited = instructionBudget > 0;
+
+  while (!frames.empty()) {
+    if (budgetLimited && instructionBudget == 0) {
+      return RUNNING;
+    }
+
+    VirtualMachineFrame &frame = frames.back();
+    VirtualMachineSector &sector = slotAt<Policy>(&sectors, frame.sectorId);
+
+    if (frame.instructionPointer >= sector.instructions.size()) {
+      // Write ahead buffers are owned by the frame, and released with it
+      frames.pop_back();
+      continue;
+    }
+
+    VirtualMachineInstruction &instruction =
+        sector.instructions[frame.instructionPointer];
+    int sectorId = frame.sectorId;
+    size_t instructionPointer = frame.instructionPointer;
+
+    // An instruction retried after blocking on input was already traced
+    if constexpr (Policy::traced) {
+      if (!waitingOnInput) {
+        traceInstruction(instanceId, sectorId, instructionPointer, instruction);
+      }
+    }
+
+    std::chrono::steady_clock::time_point instructionStart;
+
+    if constexpr (Policy::profiled) {
+      instructionStart = std::chrono::steady_clock::now();
+    }
+
+    bool executed;
+
+    if constexpr (Policy::checked) {
+      // Report where the program failed, not just why
+      try {
+        executed = step<Policy>(frame, instruction);
+      } catch (const std::exception &e) {
+        throwInstructionError(sectorId, instructionPointer, instruction, e);
+      }
+    } else {
+      executed = step<Policy>(frame, instruction);
+    }
+
+    waitingOnInput = !executed;
+
+    if (waitingOnInput) {
+      return BLOCKED;
+    }
+
+    if constexpr (Policy::profiled) {
+      profile.instructionCounts[instruction.op]++;
+      profile.instructionTime[instruction.op] +=
+          std::chrono::steady_clock::now() - instructionStart;
+    }
+
+    if (budgetLimited) {
+      instructionBudget--;
+    }
+  }
+
+  return HALTED;
+}
+
 VirtualMachineInstructionType instructionNameToType(std::string name) {
   if (name == "BUFWRITE") {
     return BUFWRITE;
@@ -228,45 +427,14 @@ VirtualMachineInstruction parseInstruction(std::string instructionLine) {
   return instruction;
 }
 
-int main(int argc, char *argv[]) {
-
-  bool virtualMachineDebugOutput = false;
-  std::string virtualMachineBytecodeFile = "";
-
-  if (argc == 1) {
-    std::cout << "Graphite virtual machine v1.0" << std::endl;
-    std::cout << "Author: Interfiber <webmaster@interfiber.dev>" << std::endl;
-    std::cout << "Syntax: " << argv[0] << " FILE OPTIONS" << std::endl;
-    std::cout << "Options: " << std::endl;
-    std::cout << "--virtual-machine-enable-debug-output  Enable debug output "
-                 "at the end of program execution"
-              << std::endl;
-    std::exit(-1);
-  } else {
-    virtualMachineBytecodeFile = std::string(argv[1]);
-  }
+std::vector<VirtualMachineSector> loadSectors(std::string bytecodeFile) {
+  std::vector<VirtualMachineSector> sectors;
+  std::ifstream ifs(bytecodeFile);
 
-  for (int i = 1; i < argc; i++) {
-    std::string arg = std::string(argv[i]);
-
-    if (arg == "--virtual-machine-enable-debug-output") {
-      virtualMachineDebugOutput = true;
-    }
+  if (!ifs) {
+    throw std::runtime_error("Could not open bytecode file: " + bytecodeFile);
   }
 
-  std::vector<VirtualMachineSector> sectors; // Program sectors
-  std::vector<VirtualMachineBuffer> buffers; // Program memory
-  std::vector<VirtualMachineBuffer>
-      tmpBuffers; // Temporary machine memory, program copies result from these
-                  // into program memory
-  std::vector<VirtualMachineRegister> registers; // Machine memory
-
-  registers.push_back(VirtualMachineRegister{0});
-  registers.push_back(VirtualMachineRegister{1});
-  registers.push_back(VirtualMachineRegister{2});
-
-  std::ifstream ifs(virtualMachineBytecodeFile);
-
   std::string line;
 
   // Load all sectors into memory
@@ -277,7 +445,7 @@ int main(int argc, char *argv[]) {
     ltrim(line); // Remove indents, if they exist
 
     if (line == "#-#" && !inSector) {
-      sector = VirtualMachineSector{sectorId, {}, {}};
+      sector = VirtualMachineSector{sectorId, {}};
       inSector = true;
 
     } else if (line == "#-#" && inSector) {
@@ -293,73 +461,234 @@ int main(int argc, char *argv[]) {
     }
   }
 
-  int totalInstructionCount = 0;
+  if (sectors.empty()) {
+    throw std::runtime_error("Bytecode file contains no sectors: " +
+                             bytecodeFile);
+  }
+
+  return sectors;
+}
+
+void printDebugOutput(VirtualMachine &vm, std::string bytecodeFile) {
+  // Render tables
+  std::cout << "---------------- PROGRAM RESULT #" << vm.instanceId << " ("
+            << bytecodeFile << ") ----------------" << std::endl;
+
+  std::cout << "--- BUFFERS ---" << std::endl;
+  TextTable t('-', '|', '+');
+  t.add("Slot");
+  t.add("Value");
+  t.endOfRow();
 
-  for (auto sector : sectors) {
-    totalInstructionCount += sector.instructions.size();
+  for (auto buffer : vm.buffers) {
+    t.add(std::to_string(buffer.slot));
+    t.add(buffer.value);
+    t.endOfRow();
   }
 
-  //  std::cout << "VirtualMachineDebug:" << std::endl;
-  //  std::cout << "Graphite Language Virtual Machine v1.0" << std::endl;
-  //  std::cout << "Found a total of " << totalInstructionCount
-  //            << " VM instructions" << std::endl;
-  // std::cout << "Found a total of " << sectors.size() << " program sectors"
-  // << std::endl;
+  t.setAlignment(2, TextTable::Alignment::RIGHT);
+  std::cout << t;
 
-  // Execute sector 0
+  TextTable rt('-', '|', '+');
 
-  sectors.at(0).execute(&registers, &buffers, &sectors, &tmpBuffers);
+  rt.add("slot");
+  rt.add("value");
+  rt.endOfRow();
 
-  if (virtualMachineDebugOutput) {
-    // Render tables
-    std::cout << "---------------- PROGRAM RESULT ----------------"
-              << std::endl;
+  for (auto mRegister : vm.registers) {
+    rt.add(std::to_string(mRegister.slot));
+    rt.add(mRegister.value);
+    rt.endOfRow();
+  }
+  rt.setAlignment(2, TextTable::Alignment::RIGHT);
 
-    std::cout << "--- BUFFERS ---" << std::endl;
-    TextTable t('-', '|', '+');
-    t.add("Slot");
-    t.add("Value");
-    t.endOfRow();
+  std::cout << "--- REGISTERS ---" << std::endl;
+  std::cout << rt;
+
+  TextTable tt('-', '|', '+');
+  tt.add("slot");
+  tt.add("value");
+  tt.endOfRow();
+
+  for (auto tmpBuffer : vm.tmpBuffers) {
+    tt.add(std::to_string(tmpBuffer.slot));
+    tt.add(tmpBuffer.value);
+    tt.endOfRow();
+  }
+
+  tt.setAlignment(2, TextTable::Alignment::RIGHT);
 
-    for (auto buffer : buffers) {
-      t.add(std::to_string(buffer.slot));
-      t.add(buffer.value);
-      t.endOfRow();
+  std::cout << "--- TEMPORARY BUFFER MEMORY ---" << std::endl;
+  std::cout << tt;
+}
+
+void printProfileOutput(VirtualMachine &vm, std::string bytecodeFile) {
+  std::cout << "--- PROFILE #" << vm.instanceId << " (" << bytecodeFile
+            << ") ---" << std::endl;
+  TextTable pt('-', '|', '+');
+  pt.add("instruction");
+  pt.add("count");
+  pt.add("time (ns)");
+  pt.endOfRow();
+
+  for (int op = 0; op < INSTRUCTION_TYPE_COUNT; op++) {
+    if (vm.profile.instructionCounts[op] == 0) {
+      continue;
     }
 
-    t.setAlignment(2, TextTable::Alignment::RIGHT);
-    std::cout << t;
+    pt.add(instructionTypeNames[op]);
+    pt.add(std::to_string(vm.profile.instructionCounts[op]));
+    pt.add(std::to_string(vm.profile.instructionTime[op].count()));
+    pt.endOfRow();
+  }
 
-    TextTable rt('-', '|', '+');
+  pt.setAlignment(2, TextTable::Alignment::RIGHT);
+  std::cout << pt;
+}
 
-    rt.add("slot");
-    rt.add("value");
-    rt.endOfRow();
+struct VirtualMachineOptions {
+  bool debugOutput = false;
+  bool boundsChecks = true;
+  bool profiling = false;
+  bool tracing = false;
+  int instructionBudget = 1000;
+  std::vector<std::string> bytecodeFiles;
+};
+
+template <typename Policy> void runPrograms(VirtualMachineOptions &options) {
+  std::deque<VirtualMachine> finished;
+
+  if (options.bytecodeFiles.size() == 1) {
+    // A single program owns the thread, run it to completion and read STDIN
+    // directly
+    finished.emplace_back(loadSectors(options.bytecodeFiles[0]));
+    finished.back().execute<Policy>();
+  } else {
+    // Interleave all programs on this thread
+    VirtualMachineScheduler scheduler(options.instructionBudget);
 
-    for (auto mRegister : registers) {
-      rt.add(std::to_string(mRegister.slot));
-      rt.add(mRegister.value);
-      rt.endOfRow();
+    for (auto file : options.bytecodeFiles) {
+      scheduler.spawn(loadSectors(file));
     }
-    rt.setAlignment(2, TextTable::Alignment::RIGHT);
 
-    std::cout << "--- REGISTERS ---" << std::endl;
-    std::cout << rt;
+    scheduler.run<Policy>();
+    finished = std::move(scheduler.instances);
+  }
 
-    TextTable tt('-', '|', '+');
-    tt.add("slot");
-    tt.add("value");
-    tt.endOfRow();
+  for (auto &vm : finished) {
+    if (options.debugOutput) {
+      printDebugOutput(vm, options.bytecodeFiles.at(vm.instanceId));
+    }
+
+    if constexpr (Policy::profiled) {
+      printProfileOutput(vm, options.bytecodeFiles.at(vm.instanceId));
+    }
+  }
+}
+
+// Pick the interpreter specialization matching the command line, one flag at
+// a time
+template <bool Checked, bool Profiled>
+void runWithTracing(VirtualMachineOptions &options) {
+  if (options.tracing) {
+    runPrograms<VirtualMachineExecutionPolicy<Checked, Profiled, true>>(
+        options);
+  } else {
+    runPrograms<VirtualMachineExecutionPolicy<Checked, Profiled, false>>(
+        options);
+  }
+}
+
+template <bool Checked> void runWithProfiling(VirtualMachineOptions &options) {
+  if (options.profiling) {
+    runWithTracing<Checked, true>(options);
+  } else {
+    runWithTracing<Checked, false>(options);
+  }
+}
+
+void printUsage(char *program) {
+  std::cout << "Graphite virtual machine v1.0" << std::endl;
+  std::cout << "Author: Interfiber <webmaster@interfiber.dev>" << std::endl;
+  std::cout << "Syntax: " << program << " FILE [FILE...] OPTIONS"
+            << std::endl;
+  std::cout << "Options: " << std::endl;
+  std::cout << "--virtual-machine-enable-debug-output  Enable debug output "
+               "at the end of program execution"
+            << std::endl;
+  std::cout << "--virtual-machine-instruction-budget N  Instructions a "
+               "program may run before yielding, when running multiple "
+               "files (default 1000)"
+            << std::endl;
+  std::cout << "--virtual-machine-disable-bounds-checks  Skip slot bounds "
+               "checks, invalid programs have undefined behaviour"
+            << std::endl;
+  std::cout << "--virtual-machine-enable-profiling  Print instruction "
+               "counts and timings at the end of program execution"
+            << std::endl;
+  std::cout << "--virtual-machine-enable-tracing  Print every executed "
+               "instruction to stderr"
+            << std::endl;
+}
+
+int main(int argc, char *argv[]) {
 
-    for (auto tmpBuffer : tmpBuffers) {
-      tt.add(std::to_string(tmpBuffer.slot));
-      tt.add(tmpBuffer.value);
-      tt.endOfRow();
+  VirtualMachineOptions options;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = std::string(argv[i]);
+
+    if (arg == "--virtual-machine-enable-debug-output") {
+      options.debugOutput = true;
+    } else if (arg == "--virtual-machine-instruction-budget") {
+      if (i + 1 >= argc) {
+        std::cerr << "Missing value for --virtual-machine-instruction-budget"
+                  << std::endl;
+        std::exit(-1);
+      }
+
+      std::string budget = std::string(argv[++i]);
+
+      try {
+        options.instructionBudget = std::stoi(budget);
+      } catch (const std::exception &) {
+        options.instructionBudget = 0;
+      }
+
+      if (options.instructionBudget <= 0) {
+        std::cerr << "Invalid instruction budget: " << budget
+                  << ", expected a positive number" << std::endl;
+        std::exit(-1);
+      }
+    } else if (arg == "--virtual-machine-disable-bounds-checks") {
+      options.boundsChecks = false;
+    } else if (arg == "--virtual-machine-enable-profiling") {
+      options.profiling = true;
+    } else if (arg == "--virtual-machine-enable-tracing") {
+      options.tracing = true;
+    } else if (arg.rfind("--", 0) == 0) {
+      std::cerr << "Unknown option: " << arg << std::endl;
+      printUsage(argv[0]);
+      std::exit(-1);
+    } else {
+      options.bytecodeFiles.push_back(arg);
     }
+  }
 
-    tt.setAlignment(2, TextTable::Alignment::RIGHT);
+  if (options.bytecodeFiles.empty()) {
+    printUsage(argv[0]);
+    std::exit(-1);
+  }
 
-    std::cout << "--- TEMPORARY BUFFER MEMORY ---" << std::endl;
-    std::cout << tt;
+#ifdef VIRTUAL_MACHINE_BASELINE
+  // Benchmark baseline, a single interpreter without bounds checks, profiling,
+  // tracing or policy dispatch, equivalent to a hand written interpreter
+  runPrograms<VirtualMachineExecutionPolicy<false, false, false>>(options);
+#else
+  if (options.boundsChecks) {
+    runWithProfiling<true>(options);
+  } else {
+    runWithProfiling<false>(options);
   }
-}
\ No newline at end of file
+#endif
+}
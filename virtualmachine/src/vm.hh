@@ -1,5 +1,9 @@
 #pragma once
 #include <algorithm>
+#include <array>
+#include <bitset>
+#include <chrono>
+#include <deque>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -26,13 +30,58 @@ static void ltrim(std::string &s) {
           }));
 }
 
+// Compile time execution policy. Every combination of flags is compiled as its
+// own interpreter, so features which are turned off cost nothing at runtime
+template <bool Checked, bool Profiled, bool Traced>
+struct VirtualMachineExecutionPolicy {
+  static constexpr bool checked = Checked;   // Bounds check slot accesses
+  static constexpr bool profiled = Profiled; // Count and time instructions
+  static constexpr bool traced = Traced;     // Print instructions to stderr
+};
+
+typedef VirtualMachineExecutionPolicy<true, false, false>
+    VirtualMachineDefaultPolicy;
+
+// Every specialization grows the translation unit, and past a certain size the
+// compiler stops inlining the instruction handlers into the interpreter loop.
+// Only the hot path is forced inline, tracing and error reporting stay out of
+// line. Both apply to every build, baseline included
+#if defined(__GNUC__)
+#define VIRTUAL_MACHINE_ALWAYS_INLINE inline __attribute__((always_inline))
+#define VIRTUAL_MACHINE_COLD __attribute__((noinline, cold))
+#else
+#define VIRTUAL_MACHINE_ALWAYS_INLINE inline
+#define VIRTUAL_MACHINE_COLD
+#endif
+
+// Slot access, bounds checked only when the policy asks for it
+template <typename Policy, typename T>
+static T &slotAt(std::vector<T> *slots, size_t slot) {
+  if constexpr (Policy::checked) {
+    return slots->at(slot);
+  } else {
+    return (*slots)[slot];
+  }
+}
+
 // Represents a single register slot in the VM
 // Each VirtualMachineRegister is only identifiable by its register slot
 struct VirtualMachineRegister {
   int slot;
   std::string value;
 
-  void writeRegisterValue(std::string v) {
+  // When false, reads from the STDIN register are served from pendingInput
+  // instead of blocking on std::cin, so a scheduler can park the program
+  bool interactive = true;
+  std::deque<std::string> pendingInput;
+
+  // Returns false when the write has to wait for input, the register is left
+  // untouched so the write can be retried once input arrives
+  bool writeRegisterValue(std::string v) {
+    if (slot == 2 && !interactive && pendingInput.empty()) {
+      return false;
+    }
+
     value = v;
 
     switch (slot) {
@@ -43,10 +92,17 @@ struct VirtualMachineRegister {
       std::cout << value;
       break;
     case 2: // Slot 2: STDIN
-      std::string input;
-      std::cin >> input;
-      value = input;
+      if (interactive) {
+        std::string input;
+        std::cin >> input;
+        value = input;
+      } else {
+        value = pendingInput.front();
+        pendingInput.pop_front();
+      }
     }
+
+    return true;
   }
 
   std::string readRegisterValue() { return value; }
@@ -70,14 +126,23 @@ enum VirtualMachineInstructionType {
   BUFRM = 14 // Remove a buffer from program memory
 };
 
+const int INSTRUCTION_TYPE_COUNT = BUFRM + 1;
+
+static const char *instructionTypeNames[INSTRUCTION_TYPE_COUNT] = {
+    "BUFWRITE",  "REGWRITE", "REGCPYTOBUF", "BUFCPYTOREG", "GOTOSECTOR",
+    "ADD",       "SUB",      "DIV",         "MUL",         "TMPBUFCPY",
+    "TMPBUFRM",  "WABWRITE", "WABRM",       "WABCPYTOBUF", "BUFRM"};
+
 struct VirtualMachineInstructionResult {
   bool gotoSector = false;
   bool writeAheadToBuffer = false;
   bool writeAheadBufferCopy = false;
+  bool writeAheadBufferRemove = false;
   int writeAheadBufferId = -1;
   int writeAheadBufferCopyId = -1;
   std::string writeAheadBufferContent = "";
   int sectorId = -1;
+  bool blockedOnInput = false;
 };
 
 struct VirtualMachineBuffer {
@@ -89,6 +154,7 @@ struct VirtualMachineInstruction {
   int op;
   std::vector<std::string> params;
 
+  template <typename Policy>
   VirtualMachineInstructionResult
   execute(std::vector<VirtualMachineRegister> *registers,
           std::vector<VirtualMachineBuffer> *buffers, std::vector<VirtualMachineBuffer> *tmpBuffers);
@@ -97,39 +163,144 @@ struct VirtualMachineInstruction {
 struct VirtualMachineSector {
   int sectorId;
   std::vector<VirtualMachineInstruction> instructions;
-  std::vector<VirtualMachineBuffer> writeAheadBuffers;
-
-  void execute(std::vector<VirtualMachineRegister> *registers,
-               std::vector<VirtualMachineBuffer> *buffers,
-               std::vector<VirtualMachineSector> *sectors, std::vector<VirtualMachineBuffer> *tmpBuffers) {
-    for (VirtualMachineInstruction instruction : instructions) {
-      VirtualMachineInstructionResult result =
-          instruction.execute(registers, buffers, tmpBuffers);
-
-      if (result.gotoSector) {
-        sectors->at(result.sectorId).execute(registers, buffers, sectors, tmpBuffers);
-        sectors->at(result.sectorId).writeAheadBuffers.clear(); // Write ahead buffers are cleared after a GOTOSECTOR call
-      } else if (result.writeAheadToBuffer){
-        VirtualMachineBuffer buffer{};
-        buffer.slot = result.writeAheadBufferId;
-        buffer.value = result.writeAheadBufferContent;
-
-        sectors->at(result.sectorId).writeAheadBuffers.push_back(buffer);
-      } else if (result.writeAheadBufferCopy) {
-        VirtualMachineBuffer writeAheadBuffer = sectors->at(sectorId).writeAheadBuffers.at(result.writeAheadBufferId);
-
-        if (result.writeAheadBufferCopyId == -1){
-          result.writeAheadBufferCopyId = sectors->at(sectorId).writeAheadBuffers.size() + 1;
-        }
-
-        VirtualMachineBuffer copyBuffer{};
-        copyBuffer.slot = result.writeAheadBufferCopyId;
-        copyBuffer.value = writeAheadBuffer.value;
-
-        buffers->push_back(copyBuffer);
+};
+
+// Number of write ahead buffer slots available to a single sector call
+const int WRITE_AHEAD_BUFFER_SLOTS = 16;
+
+// Fixed capacity set of write ahead buffers, indexed by slot. Values are moved
+// in and out of the mailbox, passing an argument to a sector never copies it
+struct VirtualMachineMailbox {
+  std::array<std::string, WRITE_AHEAD_BUFFER_SLOTS> values;
+  std::bitset<WRITE_AHEAD_BUFFER_SLOTS> occupied;
+
+  VirtualMachineMailbox() = default;
+
+  // Only occupied slots are moved, a call without arguments moves no strings.
+  // The mailbox being moved from is left empty
+  VirtualMachineMailbox(VirtualMachineMailbox &&other) noexcept
+      : occupied(other.occupied) {
+    for (int slot = 0; slot < WRITE_AHEAD_BUFFER_SLOTS; slot++) {
+      if (occupied[slot]) {
+        values[slot] = std::move(other.values[slot]);
       }
     }
+
+    other.occupied.reset();
+  }
+
+  template <typename Policy>
+  VIRTUAL_MACHINE_ALWAYS_INLINE void write(int slot, std::string value) {
+    if constexpr (Policy::checked) {
+      values.at(slot) = std::move(value);
+      occupied.set(slot);
+    } else {
+      values[slot] = std::move(value);
+      occupied[slot] = true;
+    }
   }
+
+  // Moves the value out of the slot, leaving the slot empty
+  template <typename Policy>
+  VIRTUAL_MACHINE_ALWAYS_INLINE std::string take(int slot) {
+    if constexpr (Policy::checked) {
+      if (!occupied.test(slot)) {
+        throw std::runtime_error("Write ahead buffer slot " +
+                                 std::to_string(slot) + " is empty");
+      }
+    }
+
+    occupied[slot] = false;
+    return std::move(values[slot]);
+  }
+
+  template <typename Policy> void remove(int slot) {
+    if constexpr (Policy::checked) {
+      values.at(slot).clear();
+    } else {
+      values[slot].clear();
+    }
+
+    occupied[slot] = false;
+  }
+};
+
+// A single entry on the sector stack, GOTOSECTOR pushes a new frame and the
+// frame is popped once its sector runs out of instructions
+struct VirtualMachineFrame {
+  int sectorId;
+  size_t instructionPointer;
+  VirtualMachineMailbox writeAheadBuffers; // Arguments passed by the caller
+};
+
+enum VirtualMachineState {
+  RUNNING = 0, // Instruction budget ran out, the program can be resumed
+  BLOCKED = 1, // Waiting on input for the STDIN register
+  HALTED = 2 // Sector stack is empty
+};
+
+// Per instruction type counters, only updated by profiled interpreters
+struct VirtualMachineProfile {
+  std::array<long long, INSTRUCTION_TYPE_COUNT> instructionCounts{};
+  std::array<std::chrono::nanoseconds, INSTRUCTION_TYPE_COUNT>
+      instructionTime{};
+};
+
+// A single program instance, owning its own memory, registers and sector
+// stack. Instances share nothing, so any number of them can be interleaved on
+// one thread
+struct VirtualMachine {
+  std::vector<VirtualMachineSector> sectors; // Program sectors
+  std::vector<VirtualMachineBuffer> buffers; // Program memory
+  std::vector<VirtualMachineBuffer>
+      tmpBuffers; // Temporary machine memory, program copies result from these
+                  // into program memory
+  std::vector<VirtualMachineRegister> registers; // Machine memory
+  std::vector<VirtualMachineFrame> frames;       // Sector stack
+
+  // Write ahead buffers written for each sector, moved into the new frame by
+  // the next GOTOSECTOR to that sector
+  std::vector<VirtualMachineMailbox> pendingWriteAheadBuffers;
+
+  VirtualMachineProfile profile;
+
+  size_t instanceId = 0; // Set by the scheduler, identifies trace output
+
+  // True while the instruction at the top of the sector stack is waiting on
+  // input, and will be retried on the next execute call
+  bool waitingOnInput = false;
+
+  VirtualMachine(std::vector<VirtualMachineSector> programSectors,
+                 bool interactive = true)
+      : sectors(std::move(programSectors)),
+        pendingWriteAheadBuffers(sectors.size()) {
+    for (int slot = 0; slot < 3; slot++) {
+      VirtualMachineRegister mRegister{slot};
+      mRegister.interactive = interactive;
+
+      registers.push_back(mRegister);
+    }
+
+    // Execution starts at sector 0
+    frames.push_back(VirtualMachineFrame{0, 0, {}});
+  }
+
+  // Queue a value for the STDIN register of a non interactive program
+  void feedInput(std::string input) {
+    registers.at(2).pendingInput.push_back(input);
+  }
+
+  // Run until the sector stack is empty, the program blocks on input, or
+  // instructionBudget instructions have been executed. A budget of zero or
+  // less runs without preemption
+  template <typename Policy = VirtualMachineDefaultPolicy>
+  VirtualMachineState execute(int instructionBudget = -1);
+
+  // Executes a single instruction and applies its result to the sector
+  // stack, returns false if the instruction blocked on input
+  template <typename Policy>
+  bool step(VirtualMachineFrame &frame,
+            VirtualMachineInstruction &instruction);
 };
 
 /*
@@ -140,7 +311,8 @@ struct VirtualMachineSector {
    buffer access, the @ symbol is for register access [statement] <-- Register
    or Buffer slot $ <-- End the special statement
 */
-static std::string evalSpecialStatement(std::string statement, std::vector<VirtualMachineBuffer> *buffers, std::vector<VirtualMachineRegister> *registers) {
+template <typename Policy>
+VIRTUAL_MACHINE_ALWAYS_INLINE static std::string evalSpecialStatement(std::string statement, std::vector<VirtualMachineBuffer> *buffers, std::vector<VirtualMachineRegister> *registers) {
 
   if (statement[0] == '$') {
     statement.pop_back(); // Remove the last character
@@ -148,10 +320,11 @@ static std::string evalSpecialStatement(std::string statement, std::vector<Virtu
     if (statement[1] == '#') {
       statement.erase(0, 2);
 
-      return buffers->at(std::stoi(statement)).value;
+      return slotAt<Policy>(buffers, std::stoi(statement)).value;
     } else if (statement[1] == '@') {
       statement.erase(0, 2);
-      return registers->at(std::stoi(statement)).readRegisterValue();
+      return slotAt<Policy>(registers, std::stoi(statement))
+          .readRegisterValue();
     } else {
       throw std::runtime_error("Invalid special statement modifier");
     }